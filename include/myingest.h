@@ -0,0 +1,19 @@
+#ifndef __MYINGEST_H__
+#define __MYINGEST_H__
+
+#define INGEST_LOTE 1024
+
+#include "mytree.h"
+
+typedef struct ingest * INGEST;
+typedef struct ticket * INGEST_TICKET;
+
+INGEST 			createINGEST				(TREE tree, long max_lote);
+void 			freeINGEST					(INGEST ing);
+void 			ingest_insere				(INGEST ing, void * key, void * data);
+INGEST_TICKET 	ingest_ticket				(INGEST ing);
+void 			ingest_wait					(INGEST ing, INGEST_TICKET ticket);
+void 			ingest_flush				(INGEST ing);
+void 			ingest_lock					(INGEST ing);
+void 			ingest_unlock				(INGEST ing);
+#endif
@@ -5,6 +5,11 @@
 #define INORDER 2
 #define PERORDER 3
 
+#define INLINE_KEY_MAX 12
+
+#define TOPK_MAX 1
+#define TOPK_MIN 2
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -15,10 +20,16 @@ typedef struct tree  * TREE;
 
 int 	TREE_balance				(TREE tre);
 TREE 	insere_tree					(TREE gl, void * key, void * data);
+TREE 	insere_batch_tree			(TREE gl, void ** keys, void ** datas, long n);
 TREE 	createTREE					(void * f_compare,void * destroy_key,void * destroy_data,void * replace);
+TREE 	createTREE_compact			(void * f_compare,void * destroy_key,void * destroy_data,void * replace,size_t key_size);
+TREE 	createTREE_bounded			(void * f_compare,void * destroy_key,void * destroy_data,void * replace,long capacidade,int keep);
+TREE 	createTREE_multimap			(void * f_compare,void * destroy_key,void * destroy_data,size_t key_size);
 void 	freeTREE_AVL				(TREE tre);
 void 	freeTREES_POSTS				(TREE postTreeId, TREE postTreeData);
 void * 	search_AVL					(TREE tree, void * key,int * valid);
+long 	equal_range_TREE			(TREE tree, void * key, void (*f_nodo)(void *,void *), void * data1);
+long 	count_TREE					(TREE tree, void * key);
 void 	all_nodes_TREE				(TREE e,void (*f_nodo)(void *,void *),void * data1);
 void 	all_nodes_With_Condition	(TREE tree, void * data1, void * data2,void (*f_nodo)(void *,void *,void *),void * data3,void * data4);
 int 	test_TREE_PROP				(TREE tree);
@@ -0,0 +1,314 @@
+/**
+ * @file 	myingest.c
+ * @brief	Ficheiro contendo a entrada assíncrona de inserções numa TREE: os produtores colocam os elementos numa
+ *			fila sem locks (vários produtores, um consumidor) e uma thread aplica-os à árvore em lotes.
+ */
+#include "myingest.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+/**
+ * Pedido colocado na fila. Um pedido com ticket não é um elemento, apenas marca
+ * que tudo o que foi colocado antes dele tem de estar aplicado quando é atingido.
+ */
+struct pedido {
+	_Atomic(struct pedido *) next;
+	void * key;
+	void * data;
+	INGEST_TICKET ticket;
+};
+
+struct ticket {
+	int feito;
+};
+
+struct ingest {
+	TREE tree;
+	_Atomic(struct pedido *) cabeca;
+	struct pedido * cauda;
+	struct pedido vazio;
+	void ** keys;
+	void ** datas;
+	long n;
+	long max_lote;
+	pthread_t aplicador;
+	pthread_mutex_t lock_tree;
+	pthread_mutex_t lock;
+	pthread_cond_t acorda;
+	pthread_cond_t feito;
+	atomic_int dormindo;
+	atomic_int terminar;
+};
+
+/**
+ * @brief			Função coloca um pedido na fila (pode ser chamada por várias threads em simultâneo).
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @param p			Apontador para o pedido.
+*/
+static void push_pedido(INGEST ing, struct pedido * p){
+	struct pedido * prev;
+
+	atomic_store(&p->next,NULL);
+	prev = atomic_exchange(&ing->cabeca,p);
+	atomic_store(&prev->next,p);
+}
+
+/**
+ * @brief			Função retira um pedido da fila (apenas a thread aplicadora a chama).
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @return 			Apontador para o pedido, NULL se a fila estiver vazia ou um produtor estiver a meio de um push.
+*/
+static struct pedido * pop_pedido(INGEST ing){
+	struct pedido * cauda = ing->cauda;
+	struct pedido * next = atomic_load(&cauda->next);
+
+	if (cauda == &ing->vazio){
+		if (!next)
+			return NULL;
+		ing->cauda = next;
+		cauda = next;
+		next = atomic_load(&next->next);
+	}
+	if (next){
+		ing->cauda = next;
+		return cauda;
+	}
+	if (cauda != atomic_load(&ing->cabeca))
+		return NULL;
+	push_pedido(ing,&ing->vazio);
+	next = atomic_load(&cauda->next);
+	if (next){
+		ing->cauda = next;
+		return cauda;
+	}
+	return NULL;
+}
+
+/**
+ * @brief			Função verifica se a fila está vazia.
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @return 			Inteiro a ser usado como boolean.
+*/
+static int fila_vazia(INGEST ing){
+	return ing->cauda == &ing->vazio && atomic_load(&ing->cabeca) == &ing->vazio;
+}
+
+/**
+ * @brief			Função acorda a thread aplicadora caso esteja à espera de pedidos.
+ * @param ing		Apontador para a estrutura de ingestão.
+*/
+static void acorda_aplicador(INGEST ing){
+	if (atomic_load(&ing->dormindo)){
+		pthread_mutex_lock(&ing->lock);
+		pthread_cond_signal(&ing->acorda);
+		pthread_mutex_unlock(&ing->lock);
+	}
+}
+
+/**
+ * @brief			Função aplica à árvore o lote acumulado.
+ * @param ing		Apontador para a estrutura de ingestão.
+*/
+static void aplica_lote(INGEST ing){
+	if (ing->n > 0){
+		pthread_mutex_lock(&ing->lock_tree);
+		insere_batch_tree(ing->tree,ing->keys,ing->datas,ing->n);
+		pthread_mutex_unlock(&ing->lock_tree);
+		ing->n = 0;
+	}
+}
+
+/**
+ * @brief			Função executada pela thread aplicadora.
+ * @param arg		Apontador para a estrutura de ingestão.
+ * @return 			NULL.
+*/
+static void * aplicador(void * arg){
+	INGEST ing = arg;
+	struct pedido * p;
+
+	while (1){
+		p = pop_pedido(ing);
+		if (p){
+			if (p->ticket){
+				aplica_lote(ing);
+				pthread_mutex_lock(&ing->lock);
+				p->ticket->feito = 1;
+				pthread_cond_broadcast(&ing->feito);
+				pthread_mutex_unlock(&ing->lock);
+			}
+			else {
+				ing->keys[ing->n] = p->key;
+				ing->datas[ing->n] = p->data;
+				if (++ing->n == ing->max_lote)
+					aplica_lote(ing);
+			}
+			free(p);
+			continue;
+		}
+		/* sem pedidos prontos: aplica o que já existe em vez de esperar por um lote cheio */
+		if (ing->n > 0){
+			aplica_lote(ing);
+			continue;
+		}
+		if (!fila_vazia(ing)){
+			sched_yield();
+			continue;
+		}
+		if (atomic_load(&ing->terminar))
+			break;
+		pthread_mutex_lock(&ing->lock);
+		atomic_store(&ing->dormindo,1);
+		if (fila_vazia(ing) && !atomic_load(&ing->terminar))
+			pthread_cond_wait(&ing->acorda,&ing->lock);
+		atomic_store(&ing->dormindo,0);
+		pthread_mutex_unlock(&ing->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief				Função cria a estrutura de ingestão e a thread que aplica os lotes à árvore.
+ * @param tree			Apontador para a árvore onde os elementos são inseridos.
+ * @param max_lote		Número máximo de elementos por lote (INGEST_LOTE se não for positivo).
+ * @return 				Apontador para a estrutura criada, NULL se não for possível criar a thread.
+ * @warning				Enquanto a estrutura existir, a árvore só pode ser acedida entre ingest_lock e ingest_unlock.
+ *						Não se pode chamar ingest_wait nem ingest_flush com ingest_lock obtido: a thread aplicadora
+ *						precisa desse lock para aplicar o lote antes de concluir o ticket, pelo que ficariam bloqueadas.
+*/
+INGEST createINGEST(TREE tree, long max_lote){
+	INGEST ing = malloc(sizeof(struct ingest));
+
+	if (max_lote <= 0)
+		max_lote = INGEST_LOTE;
+	ing->tree = tree;
+	atomic_store(&ing->vazio.next,NULL);
+	ing->vazio.ticket = NULL;
+	atomic_store(&ing->cabeca,&ing->vazio);
+	ing->cauda = &ing->vazio;
+	ing->keys = malloc(max_lote * sizeof(void *));
+	ing->datas = malloc(max_lote * sizeof(void *));
+	ing->n = 0;
+	ing->max_lote = max_lote;
+	atomic_store(&ing->dormindo,0);
+	atomic_store(&ing->terminar,0);
+	pthread_mutex_init(&ing->lock_tree,NULL);
+	pthread_mutex_init(&ing->lock,NULL);
+	pthread_cond_init(&ing->acorda,NULL);
+	pthread_cond_init(&ing->feito,NULL);
+
+	if (pthread_create(&ing->aplicador,NULL,aplicador,ing) != 0){
+		pthread_mutex_destroy(&ing->lock_tree);
+		pthread_mutex_destroy(&ing->lock);
+		pthread_cond_destroy(&ing->acorda);
+		pthread_cond_destroy(&ing->feito);
+		free(ing->keys);
+		free(ing->datas);
+		free(ing);
+		return NULL;
+	}
+
+	return ing;
+}
+
+/**
+ * @brief			Função aplica os pedidos pendentes, termina a thread aplicadora e liberta a estrutura.
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @note			A árvore não é libertada. Só pode ser chamada depois de todos os produtores terem terminado as
+ *					chamadas a ingest_insere e ingest_ticket; um pedido colocado durante ou depois da chamada pode
+ *					não ser aplicado e aceder a memória já libertada.
+*/
+void freeINGEST(INGEST ing){
+	if (ing){
+		pthread_mutex_lock(&ing->lock);
+		atomic_store(&ing->terminar,1);
+		pthread_cond_signal(&ing->acorda);
+		pthread_mutex_unlock(&ing->lock);
+		pthread_join(ing->aplicador,NULL);
+
+		pthread_mutex_destroy(&ing->lock_tree);
+		pthread_mutex_destroy(&ing->lock);
+		pthread_cond_destroy(&ing->acorda);
+		pthread_cond_destroy(&ing->feito);
+		free(ing->keys);
+		free(ing->datas);
+		free(ing);
+	}
+}
+
+/**
+ * @brief			Função coloca um elemento na fila para ser inserido na árvore.
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @param key		Apontador para a key a inserir.
+ * @param data		Apontador para a data a inserir.
+*/
+void ingest_insere(INGEST ing, void * key, void * data){
+	struct pedido * p = malloc(sizeof(struct pedido));
+
+	p->key = key;
+	p->data = data;
+	p->ticket = NULL;
+	push_pedido(ing,p);
+	acorda_aplicador(ing);
+}
+
+/**
+ * @brief			Função cria um ticket que fica concluído quando todos os elementos colocados antes dele estiverem na árvore.
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @return 			Ticket a passar a ingest_wait.
+*/
+INGEST_TICKET ingest_ticket(INGEST ing){
+	struct pedido * p = malloc(sizeof(struct pedido));
+	INGEST_TICKET ticket = malloc(sizeof(struct ticket));
+
+	ticket->feito = 0;
+	p->key = NULL;
+	p->data = NULL;
+	p->ticket = ticket;
+	push_pedido(ing,p);
+	acorda_aplicador(ing);
+
+	return ticket;
+}
+
+/**
+ * @brief			Função espera que um ticket seja concluído e liberta-o.
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @param ticket	Ticket devolvido por ingest_ticket.
+ * @warning			Não pode ser chamada com ingest_lock obtido (bloqueia para sempre).
+*/
+void ingest_wait(INGEST ing, INGEST_TICKET ticket){
+	pthread_mutex_lock(&ing->lock);
+	while (!ticket->feito)
+		pthread_cond_wait(&ing->feito,&ing->lock);
+	pthread_mutex_unlock(&ing->lock);
+	free(ticket);
+}
+
+/**
+ * @brief			Função espera que todos os elementos colocados até ao momento estejam na árvore.
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @warning			Não pode ser chamada com ingest_lock obtido (bloqueia para sempre).
+*/
+void ingest_flush(INGEST ing){
+	ingest_wait(ing,ingest_ticket(ing));
+}
+
+/**
+ * @brief			Função obtém acesso exclusivo à árvore (bloqueia a aplicação de lotes).
+ * @param ing		Apontador para a estrutura de ingestão.
+ * @warning			Até ingest_unlock não se pode chamar ingest_wait nem ingest_flush.
+*/
+void ingest_lock(INGEST ing){
+	pthread_mutex_lock(&ing->lock_tree);
+}
+
+/**
+ * @brief			Função liberta o acesso exclusivo à árvore.
+ * @param ing		Apontador para a estrutura de ingestão.
+*/
+void ingest_unlock(INGEST ing){
+	pthread_mutex_unlock(&ing->lock_tree);
+}
@@ -3,23 +3,54 @@
  * @brief	Ficheiro contendo funções utilizadas na construção da AVL utilizada no programa bem como todas as funcionalidades pela mesma suportadas.
  */
 #include "mytree.h"
+#include <stdint.h>
 
 
 #define MAX(a,b) a > b ? a : b;
-#define MAX_SIZE 40
+#define MAX_SIZE 48
+#define NIL 0
+#define INITIAL_CAP 16
 
+/**
+ * Os nodos vivem num array por árvore e referem-se uns aos outros por índices
+ * de 32 bits. O índice 0 é reservado como sentinela (altura 0), pelo que um
+ * filho nulo é simplesmente NIL. O campo key guarda ou o apontador para a key
+ * ou, em modo compacto, os próprios bytes da key (até INLINE_KEY_MAX).
+ * Nodos removidos ficam com altura 0 e são encadeados pelo campo esq numa
+ * lista de nodos livres, reutilizados pelas inserções seguintes.
+ * Numa árvore multimap, um nodo com mais do que um valor tem run a 1 e o
+ * campo data aponta para um struct run com os valores da key.
+ */
 struct AVBin {
-    int altura;
-    void * key;
 	void * data;
-    struct AVBin * esq, * dir;
+	uint32_t esq, dir;
+	unsigned char key[INLINE_KEY_MAX];
+	unsigned char altura;
+	unsigned char run;
 };
 
-typedef struct AVBin * AVL;
+struct run {
+	long n, cap;
+	void * vals[];
+};
+
+typedef uint32_t AVL;
+
+#define NODO(t,i) ((t)->nodos[(i)])
 
 struct tree{
+    struct AVBin * nodos;
+    uint32_t cap;
+    uint32_t usados;
+    AVL livres;
     AVL arv;
+    AVL menor, maior;
     long nnodes;
+    long ninsercoes;
+    long capacidade;
+    int keep;
+    int multimap;
+    size_t key_size;
 	void * (*replace_fun)(void *,void *);
     int (*f_compare)(void *,void *);
 	void (*destroy_key)(void *);
@@ -27,24 +58,105 @@ struct tree{
     int heigth;
 };
 
+/**
+ * @brief			Função devolve a key de um nodo.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
+ * @return 			Apontador para a key (para os bytes guardados no nodo em modo compacto).
+*/
+static inline void * node_key(TREE t, AVL a){
+	void * key;
+	if (t->key_size)
+		return NODO(t,a).key;
+	memcpy(&key,NODO(t,a).key,sizeof(void *));
+	return key;
+}
+
+/**
+ * @brief			Função devolve os valores de um nodo.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
+ * @param n			Apontador onde é guardado o número de valores.
+ * @return 			Array com os valores do nodo (válido até à próxima inserção).
+*/
+static void ** node_values(TREE t, AVL a, long * n){
+	struct run * r;
+	if (NODO(t,a).run){
+		r = NODO(t,a).data;
+		*n = r->n;
+		return r->vals;
+	}
+	*n = 1;
+	return &NODO(t,a).data;
+}
+
+/**
+ * @brief			Função acrescenta um valor a um nodo de uma árvore multimap.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
+ * @param data		Apontador para a data a acrescentar.
+*/
+static void adiciona_valor(TREE t, AVL a, void * data){
+	struct run * r;
+	if (!NODO(t,a).run){
+		r = malloc(sizeof(struct run) + 2 * sizeof(void *));
+		r->n = 1;
+		r->cap = 2;
+		r->vals[0] = NODO(t,a).data;
+		NODO(t,a).run = 1;
+	}
+	else {
+		r = NODO(t,a).data;
+		if (r->n == r->cap){
+			r->cap *= 2;
+			r = realloc(r,sizeof(struct run) + r->cap * sizeof(void *));
+		}
+	}
+	r->vals[r->n++] = data;
+	NODO(t,a).data = r;
+}
+
+/**
+ * @brief			Função liberta a key e os valores de um nodo.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
+*/
+static void destroy_node(TREE t, AVL a){
+	void ** vals;
+	long i, k;
+
+	if (t->destroy_key != NULL && !t->key_size)
+		t->destroy_key(node_key(t,a));
+	vals = node_values(t,a,&k);
+	if (t->destroy_data != NULL)
+		for (i = 0; i < k; i++)
+			t->destroy_data(vals[i]);
+	if (NODO(t,a).run){
+		free(NODO(t,a).data);
+		NODO(t,a).run = 0;
+	}
+}
+
 /**
  * @brief			Função calcula a altura de um nodo.
- * @param a			Apontador para a árvore.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
  * @return 			Altura de um nodo.
 */
-static int altura(AVL a) {
-    return a ? a-> altura : 0;
+static int altura(TREE t, AVL a) {
+    return NODO(t,a).altura;
 }
 
 /**
  * @brief			Função calcula o balanço de um nodo.
- * @param a			Apontador para a árvore.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
  * @return 			Inteiro com o valor do balanço.
 */
-static int balanceDEEP(AVL a) {
+static int balanceDEEP(TREE t, AVL a) {
     int balance = 0;
     if (a){
-        balance = altura(a->dir) - altura(a->esq);
+        balance = altura(t,NODO(t,a).dir) - altura(t,NODO(t,a).esq);
     }
 
     return balance;
@@ -52,15 +164,16 @@ static int balanceDEEP(AVL a) {
 
 /**
  * @brief			Função calcula a altura de uma árvore.
- * @param a			Apontador para a árvore.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice da raiz da árvore.
  * @return 			Altura da árvore.
 */
-static int cal_altura(AVL a){
+static int cal_altura(TREE t, AVL a){
     int h = 0;
     int h1, h2;
     if(a){
-        h1 = cal_altura(a->esq);
-        h2 = cal_altura(a->dir);
+        h1 = cal_altura(t,NODO(t,a).esq);
+        h2 = cal_altura(t,NODO(t,a).dir);
 
         h = h1 > h2 ? h1 + 1 : h2 +1;
     }
@@ -70,16 +183,17 @@ static int cal_altura(AVL a){
 
 /**
  * @brief			Função verifica se a árvore é balanceada.
- * @param	a		Apontador para a árvore.
+ * @param	t		Apontador para a estrutura.
+ * @param	a		Índice da raiz da árvore.
  * @return 			Inteiro a ser usado como boolean.
 */
-static int isBalanced(AVL a){
+static int isBalanced(TREE t, AVL a){
     int r = 1;
     int b;
     if(a){
-        b = cal_altura(a->dir) - cal_altura(a->esq);
+        b = cal_altura(t,NODO(t,a).dir) - cal_altura(t,NODO(t,a).esq);
         if ((b >= -1) && (b <= 1))
-            r = isBalanced(a->esq) && isBalanced(a->dir);
+            r = isBalanced(t,NODO(t,a).esq) && isBalanced(t,NODO(t,a).dir);
         else r = 0;
     }
 
@@ -92,171 +206,307 @@ static int isBalanced(AVL a){
  * @return 			Inteiro a ser usado como boolean.
 */
 int TREE_balance(TREE tre){
-	return isBalanced(tre->arv);
+	return isBalanced(tre,tre->arv);
 }
 
 /**
- * @brief			Função efetua uma rotação para a direita da árvore.
- * @param	a		Apontador para a árvore.
- * @return 			Árvore após ser rodada para a direita.
+ * @brief			Função atualiza a altura de um nodo a partir das alturas dos filhos.
+ * @param	t		Apontador para a estrutura.
+ * @param	a		Índice do nodo.
 */
-static AVL rotate_rigth(AVL a){
+static void implementa_alt(TREE t, AVL a){
 
-    int ha_r, ha_l;
+    int hl,hr;
 
-    AVL aux = a -> esq;
-    a->esq = aux -> dir;
-    aux -> dir = a;
+    hr = altura(t,NODO(t,a).dir);
+    hl = altura(t,NODO(t,a).esq);
+    NODO(t,a).altura = hr > hl ? hr + 1 : hl + 1;
 
+}
 
-    ha_r = altura(a->dir);
-    ha_l = altura(a->esq);
-    a->altura = ha_r > ha_l ? ha_r + 1 : ha_l + 1;
+/**
+ * @brief			Função efetua uma rotação para a direita da árvore.
+ * @param	t		Apontador para a estrutura.
+ * @param	a		Índice da raiz da árvore.
+ * @return 			Índice da raiz após ser rodada para a direita.
+*/
+static AVL rotate_rigth(TREE t, AVL a){
+
+    AVL aux = NODO(t,a).esq;
+    NODO(t,a).esq = NODO(t,aux).dir;
+    NODO(t,aux).dir = a;
 
-    ha_l = altura(aux->esq);
-    ha_r = a->altura;
-    aux->altura = ha_r > ha_l ? ha_r + 1 : ha_l + 1;
+    implementa_alt(t,a);
+    implementa_alt(t,aux);
 
     return aux;
 }
 
 /**
  * @brief			Função efetua uma rotação para a esquerda da árvore.
- * @param	a		Apontador para a árvore.
- * @return 			Árvore após ser rodada para a esquerda.
+ * @param	t		Apontador para a estrutura.
+ * @param	a		Índice da raiz da árvore.
+ * @return 			Índice da raiz após ser rodada para a esquerda.
 */
-static AVL rotate_left(AVL a){
-
-    int ha_r, ha_l;
+static AVL rotate_left(TREE t, AVL a){
 
-    AVL aux = a->dir;
-    a->dir = aux -> esq;
-    aux->esq = a;
-
-    ha_l = altura(a->esq);
-    ha_r = altura(a->dir);
-    a->altura = ha_r > ha_l ? ha_r + 1 : ha_l + 1;
-
-    ha_r = altura(aux->dir);
-    ha_l = a->altura;
-    aux->altura = ha_r > ha_l ? ha_r + 1 : ha_l + 1;
+    AVL aux = NODO(t,a).dir;
+    NODO(t,a).dir = NODO(t,aux).esq;
+    NODO(t,aux).esq = a;
 
+    implementa_alt(t,a);
+    implementa_alt(t,aux);
 
     return aux;
 }
 
 /**
  * @brief			Função efetua o balanceamento da árvore.
- * @param	a		Apontador para a árvore.
- * @return 			Árvore balanceada.
+ * @param	t		Apontador para a estrutura.
+ * @param	a		Índice da raiz da árvore.
+ * @return 			Índice da raiz da árvore balanceada.
 */
-static AVL balance(AVL a){
+static AVL balance(TREE t, AVL a){
 
     int hd, hl;
 
-    hd = altura(a->dir);
-    hl = altura(a->esq);
+    hd = altura(t,NODO(t,a).dir);
+    hl = altura(t,NODO(t,a).esq);
 
     int bal = hd -hl;
 
 
     if (bal == -2){
-        if (balanceDEEP(a->esq) == 1)
-            a->esq = rotate_left(a->esq);
-        a = rotate_rigth(a);
+        if (balanceDEEP(t,NODO(t,a).esq) == 1)
+            NODO(t,a).esq = rotate_left(t,NODO(t,a).esq);
+        a = rotate_rigth(t,a);
     }
     if (bal == 2){
-        if (balanceDEEP(a->dir) == -1)
-            a->dir = rotate_rigth(a->dir);
-        a = rotate_left(a);
+        if (balanceDEEP(t,NODO(t,a).dir) == -1)
+            NODO(t,a).dir = rotate_rigth(t,NODO(t,a).dir);
+        a = rotate_left(t,a);
     }
 
     return a;
 }
 
 /**
- * @brief			Função que implementa a nova altura de um dado nodo.
- * @param	a		Apontador para a árvore.
+ * @brief			Função garante que o array de nodos tem espaço para um dado número de posições.
+ * @param t			Apontador para a estrutura.
+ * @param precisa	Número de posições necessárias (incluindo a sentinela).
+ * @return 			Inteiro a ser usado como boolean: 0 se os índices de 32 bits se esgotarem ou a memória falhar.
+ * @warning			Pode realocar o array de nodos; referências para nodos obtidas antes da chamada deixam de ser válidas.
 */
-static void implementa_alt(AVL * a){
-
-    int hl,hr;
-
-    AVL aux = * a;
-    hr = altura(aux->dir);
-    hl = altura(aux->esq);
-    aux->altura = hr > hl ? hr + 1 : hl + 1;
-
+static int reserva_nodos(TREE t, uint64_t precisa){
+    uint64_t cap = t->cap;
+    struct AVBin * nodos;
+
+    if (precisa <= cap)
+        return 1;
+    if (precisa > UINT32_MAX)
+        return 0;
+    if (cap < INITIAL_CAP)
+        cap = INITIAL_CAP;
+    while (cap < precisa)
+        cap *= 2;
+    if (cap > UINT32_MAX)
+        cap = UINT32_MAX;
+    nodos = realloc(t->nodos,cap * sizeof(struct AVBin));
+    if (!nodos)
+        return 0;
+    t->nodos = nodos;
+    t->cap = (uint32_t) cap;
+
+    return 1;
 }
 
 /**
- * @brief			Função que cria um novo nodo.
+ * @brief			Função que cria um novo nodo no array de nodos da estrutura.
+ * @param t			Apontador para a estrutura.
  * @param key		Apontador a key.
  * @param data		Apontador para a data.
- * @return 			Apontador para o nodo da árvore.
+ * @return 			Índice do nodo criado, NIL se não houver espaço para mais nodos.
+ * @warning			Pode realocar o array de nodos; referências para nodos obtidas antes da chamada deixam de ser válidas.
 */
-static AVL create_new_node(void * key, void * data){
+static AVL create_new_node(TREE t, void * key, void * data){
     AVL a;
-    a = malloc(sizeof(struct AVBin));
-    a -> altura = 1;
-    a -> key = key;
-	a -> data = data;
-    a -> esq = NULL;
-    a -> dir = NULL;
+    struct AVBin * n;
+
+    if (t->livres){
+        a = t->livres;
+        t->livres = NODO(t,a).esq;
+    }
+    else {
+        if (!reserva_nodos(t,(uint64_t) t->usados + 1))
+            return NIL;
+        a = t->usados++;
+    }
+    n = &NODO(t,a);
+    n -> altura = 1;
+    if (t->key_size)
+        memcpy(n->key,key,t->key_size);
+    else memcpy(n->key,&key,sizeof(void *));
+	n -> data = data;
+    n -> run = 0;
+    n -> esq = NIL;
+    n -> dir = NIL;
 
     return a;
 }
 
+/**
+ * @brief			Função recalcula o menor e o maior nodo da árvore.
+ * @param t			Apontador para a estrutura.
+*/
+static void atualiza_extremos(TREE t){
+    AVL a = t->arv;
+
+    t->menor = t->maior = a;
+    if (a){
+        while (NODO(t,t->menor).esq)
+            t->menor = NODO(t,t->menor).esq;
+        while (NODO(t,t->maior).dir)
+            t->maior = NODO(t,t->maior).dir;
+    }
+}
+
+/**
+ * @brief			Função remove o menor ou o maior nodo da árvore, rebalanceando o caminho até à raiz.
+ * @param t			Apontador para a estrutura.
+ * @param maior		Inteiro a ser usado como boolean: remove o maior nodo se verdadeiro, o menor caso contrário.
+*/
+static void remove_extremo(TREE t, int maior){
+
+    AVL queue[MAX_SIZE];
+    AVL a = t->arv;
+    AVL filho, pai;
+
+    int idx = 0;
+    queue[idx++] = NIL;
+
+    if (!a)
+        return;
+
+    while (maior ? NODO(t,a).dir : NODO(t,a).esq){
+        queue[idx++] = a;
+        a = maior ? NODO(t,a).dir : NODO(t,a).esq;
+    }
+    filho = maior ? NODO(t,a).esq : NODO(t,a).dir;
+
+	destroy_node(t,a);
+    NODO(t,a).altura = 0;
+    NODO(t,a).esq = t->livres;
+    t->livres = a;
+    t->nnodes--;
+
+    a = filho;
+    while(1){
+        pai = queue[--idx];
+        if (!pai)
+            break;
+        if (maior)
+            NODO(t,pai).dir = a;
+        else NODO(t,pai).esq = a;
+        a = pai;
+        implementa_alt(t,a);
+        a = balance(t,a);
+    }
+    t->arv = a;
+    atualiza_extremos(t);
+}
+
 /**
  * @brief			Função insere um elemento na árvore.
  * @param gl		Apontador para a estrutura que guarda a árvore.
  * @param key		Apontador para a key a inserir.
  * @param data		Apontador para a data a inserir.
- * @return 			Apontador para a estrutura após ser inserido o valor.
+ * @return 			Apontador para a estrutura após ser inserido o valor, NULL se não houver espaço para mais nodos
+ *					(a árvore fica inalterada e key e data continuam a pertencer a quem chamou).
+ * @note			Numa árvore limitada (createTREE_bounded) cheia, um elemento pior que o extremo guardado é
+ *					rejeitado (key e data destruídas); caso contrário o extremo oposto é removido.
 */
 TREE insere_tree(TREE gl, void * key, void * data){
 
     AVL queue[MAX_SIZE];
     AVL a = gl->arv;
+    AVL novo = NIL;
 	int replace = 0;
 	int side;
+	int so_esq = 1, so_dir = 1;
 
     int idx = 0;
-    queue[idx++] = NULL;
+    queue[idx++] = NIL;
+
+	gl->ninsercoes++;
+	if (gl->capacidade > 0 && gl->nnodes >= gl->capacidade){
+		side = gl->f_compare(node_key(gl,gl->keep == TOPK_MAX ? gl->menor : gl->maior),key);
+		if (gl->keep == TOPK_MIN)
+			side = -side;
+		if (side < 0 || (side == 0 && gl->replace_fun == NULL)){
+			if (gl->destroy_key != NULL)
+				gl->destroy_key(key);
+			if (gl->destroy_data != NULL)
+				gl->destroy_data(data);
+			return gl;
+		}
+	}
 
     if (!a){
-        a = create_new_node(key,data);
+        a = novo = create_new_node(gl,key,data);
+        if (!novo){
+            gl->ninsercoes--;
+            return NULL;
+        }
 		gl->arv = a;
     }
     else{
         while(1){
-			side = (gl->f_compare(a->key,key));
+			side = (gl->f_compare(node_key(gl,a),key));
 			if (side == 0){
+				if (gl->multimap){
+					replace = 1;
+					adiciona_valor(gl,a,data);
+					if (gl->destroy_key != NULL && !gl->key_size)
+						gl->destroy_key(key);
+					break;
+				}
 				if (gl->replace_fun != NULL){
 					replace = 1;
-					a->data=gl->replace_fun(a->data,data);
-					if (gl->destroy_key != NULL)
+					NODO(gl,a).data=gl->replace_fun(NODO(gl,a).data,data);
+					if (gl->destroy_key != NULL && !gl->key_size)
 						gl->destroy_key(key);
 					break;
 				}
 			}
             if (side > 0){
-                if (a->dir){
+                so_esq = 0;
+                if (NODO(gl,a).dir){
                     queue[idx++] = a;
-                    a = a->dir;
+                    a = NODO(gl,a).dir;
                 }
                 else {
-                    a->dir = create_new_node(key,data);
+                    novo = create_new_node(gl,key,data);
+                    if (!novo){
+                        gl->ninsercoes--;
+                        return NULL;
+                    }
+                    NODO(gl,a).dir = novo;
                     break;
                 }
             }
             else {
-                if (a->esq){
+                so_dir = 0;
+                if (NODO(gl,a).esq){
                     queue[idx++] = a;
-                    a = a->esq;
+                    a = NODO(gl,a).esq;
                 }
                 else{
-                    a->esq = create_new_node(key,data);
+                    novo = create_new_node(gl,key,data);
+                    if (!novo){
+                        gl->ninsercoes--;
+                        return NULL;
+                    }
+                    NODO(gl,a).esq = novo;
                     break;
                 }
             }
@@ -267,16 +517,16 @@ TREE insere_tree(TREE gl, void * key, void * data){
 		if (replace == 0){
         	while(1){
             	pai = queue[--idx];
-            	check_side = ((!pai) ||pai->esq == a);
-            	implementa_alt(&a);
-            	balan = altura(a->dir) - altura(a->esq);
+            	check_side = ((!pai) || NODO(gl,pai).esq == a);
+            	implementa_alt(gl,a);
+            	balan = altura(gl,NODO(gl,a).dir) - altura(gl,NODO(gl,a).esq);
             	if (balan < -1 || balan > 1){
-                	a = balance(a);
+                	a = balance(gl,a);
                 	if (!pai)
                     	break;
                 	else if (check_side)
-                    	pai->esq = a;
-                	else pai->dir = a;
+                    	NODO(gl,pai).esq = a;
+                	else NODO(gl,pai).dir = a;
             	}
             	if(!pai)
                 	break;
@@ -285,25 +535,304 @@ TREE insere_tree(TREE gl, void * key, void * data){
 			gl->arv = a;
 		}
     }
-	gl->nnodes++;
+	/* em modo compacto a key foi copiada para o nodo */
+	if (gl->key_size && gl->destroy_key != NULL)
+		gl->destroy_key(key);
+
+	if (novo){
+		if (so_esq)
+			gl->menor = novo;
+		if (so_dir)
+			gl->maior = novo;
+		gl->nnodes++;
+		if (gl->capacidade > 0 && gl->nnodes > gl->capacidade)
+			remove_extremo(gl,gl->keep == TOPK_MIN);
+	}
 
     return gl;
 
 }
 
 /**
- * @brief					Função cria a estrutura que contêm a árvore.
+ * Elemento de um lote de inserções.
+ */
+struct elem {
+	void * key;
+	void * data;
+};
+
+/**
+ * @brief			Função ordena um lote de elementos pelas keys.
+ * @param t			Apontador para a estrutura com a função de comparação.
+ * @param v			Array a ordenar.
+ * @param aux		Array auxiliar com o mesmo tamanho.
+ * @param n			Número de elementos.
+ * @note			Com replace_fun ou numa árvore multimap as keys iguais ficam pela ordem do lote, para serem
+ *					combinadas por essa ordem; caso contrário ficam pela ordem inversa, tal como insere_tree coloca
+ *					cada key igual antes das que já existem.
+*/
+static void ordena_lote(TREE t, struct elem * v, struct elem * aux, long n){
+	long meio = n / 2, i = 0, j = meio, k = 0;
+	int inverte = !t->multimap && t->replace_fun == NULL;
+	int side;
+
+	if (n < 2)
+		return;
+	ordena_lote(t,v,aux,meio);
+	ordena_lote(t,v + meio,aux,n - meio);
+	while (i < meio && j < n){
+		side = t->f_compare(v[j].key,v[i].key);
+		if (side > 0 || (side == 0 && inverte))
+			aux[k++] = v[j++];
+		else aux[k++] = v[i++];
+	}
+	while (i < meio)
+		aux[k++] = v[i++];
+	while (j < n)
+		aux[k++] = v[j++];
+	memcpy(v,aux,n * sizeof(struct elem));
+}
+
+/**
+ * @brief			Função constrói uma árvore perfeitamente balanceada a partir de nodos ordenados.
+ * @param t			Apontador para a estrutura.
+ * @param ordem		Array com os índices dos nodos por ordem.
+ * @param n			Número de nodos.
+ * @return 			Índice da raiz da árvore construída.
+*/
+static AVL constroi_AVL(TREE t, AVL * ordem, long n){
+	AVL a;
+	long meio = n / 2;
+
+	if (n <= 0)
+		return NIL;
+	a = ordem[meio];
+	NODO(t,a).esq = constroi_AVL(t,ordem,meio);
+	NODO(t,a).dir = constroi_AVL(t,ordem + meio + 1,n - meio - 1);
+	implementa_alt(t,a);
+
+	return a;
+}
+
+/**
+ * @brief			Função junta a árvore l, o nodo k e a árvore r (com as keys de l antes de k e as de r depois).
+ * @param t			Apontador para a estrutura.
+ * @param l			Índice da raiz da árvore da esquerda.
+ * @param k			Índice do nodo do meio.
+ * @param r			Índice da raiz da árvore da direita.
+ * @return 			Índice da raiz da árvore balanceada resultante.
+*/
+static AVL junta_AVL(TREE t, AVL l, AVL k, AVL r){
+	AVL aux;
+
+	if (altura(t,l) > altura(t,r) + 1){
+		aux = junta_AVL(t,NODO(t,l).dir,k,r);
+		NODO(t,l).dir = aux;
+		implementa_alt(t,l);
+		return balance(t,l);
+	}
+	if (altura(t,r) > altura(t,l) + 1){
+		aux = junta_AVL(t,l,k,NODO(t,r).esq);
+		NODO(t,r).esq = aux;
+		implementa_alt(t,r);
+		return balance(t,r);
+	}
+	NODO(t,k).esq = l;
+	NODO(t,k).dir = r;
+	implementa_alt(t,k);
+
+	return k;
+}
+
+/**
+ * @brief			Função junta um elemento do lote ao nodo com a mesma key (com replace_fun ou, numa árvore multimap, nos valores do nodo).
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
+ * @param e			Apontador para o elemento do lote.
+*/
+static void junta_valor(TREE t, AVL a, struct elem * e){
+	if (t->multimap)
+		adiciona_valor(t,a,e->data);
+	else NODO(t,a).data = t->replace_fun(NODO(t,a).data,e->data);
+	if (t->destroy_key != NULL)
+		t->destroy_key(e->key);
+}
+
+/**
+ * @brief			Função cria os nodos de um lote ordenado e constrói com eles uma árvore balanceada.
+ * @param t			Apontador para a estrutura.
+ * @param lote		Lote ordenado por ordena_lote.
+ * @param n			Número de elementos do lote.
+ * @param ordem		Array auxiliar com espaço para pelo menos n índices.
+ * @return 			Índice da raiz da árvore construída.
+*/
+static AVL cria_lote(TREE t, struct elem * lote, long n, AVL * ordem){
+	AVL a;
+	long j, k = 0;
+
+	/* caso mais comum com keys aleatórias: um só elemento chega a cada folha */
+	if (n == 1){
+		a = create_new_node(t,lote[0].key,lote[0].data);
+		if (t->key_size && t->destroy_key != NULL)
+			t->destroy_key(lote[0].key);
+		t->nnodes++;
+		return a;
+	}
+	for (j = 0; j < n; j++){
+		if ((t->multimap || t->replace_fun != NULL) && k > 0 && t->f_compare(node_key(t,ordem[k - 1]),lote[j].key) == 0)
+			junta_valor(t,ordem[k - 1],&lote[j]);
+		else {
+			ordem[k++] = create_new_node(t,lote[j].key,lote[j].data);
+			if (t->key_size && t->destroy_key != NULL)
+				t->destroy_key(lote[j].key);
+		}
+	}
+	a = constroi_AVL(t,ordem,k);
+	t->nnodes += k;
+
+	return a;
+}
+
+/**
+ * @brief			Função procura num lote ordenado o primeiro elemento maior ou igual à key de um nodo.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice do nodo.
+ * @param lote		Lote ordenado.
+ * @param n			Número de elementos do lote.
+ * @param igual		Apontador onde é guardado se o elemento encontrado tem a mesma key que o nodo.
+ * @return 			Posição do elemento no lote (n se não existir).
+*/
+static long procura_lote(TREE t, AVL a, struct elem * lote, long n, int * igual){
+	long lo = 0, hi = n, meio;
+	int side;
+
+	*igual = 0;
+	while (lo < hi){
+		meio = lo + (hi - lo) / 2;
+		side = t->f_compare(lote[meio].key,node_key(t,a));
+		if (side > 0)
+			lo = meio + 1;
+		else {
+			hi = meio;
+			*igual = (side == 0);
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * @brief			Função insere um lote ordenado numa árvore numa só passagem: o lote é partido pela key de cada
+ *					nodo, cada parte desce uma vez para a subárvore respetiva e a árvore é rebalanceada na subida.
+ * @param t			Apontador para a estrutura.
+ * @param a			Índice da raiz da árvore.
+ * @param lote		Lote ordenado por ordena_lote.
+ * @param n			Número de elementos do lote.
+ * @param ordem		Array auxiliar com espaço para pelo menos n índices, partilhado por todas as chamadas.
+ * @return 			Índice da raiz da árvore após a inserção.
+*/
+static AVL insere_lote(TREE t, AVL a, struct elem * lote, long n, AVL * ordem){
+	AVL esq, dir;
+	long lb, ub, i;
+	int igual;
+
+	if (n <= 0)
+		return a;
+	if (!a)
+		return cria_lote(t,lote,n,ordem);
+
+	lb = procura_lote(t,a,lote,n,&igual);
+	ub = lb;
+	if (igual)
+		for (ub = lb + 1; ub < n && t->f_compare(node_key(t,a),lote[ub].key) == 0; ub++)
+			;
+	if (t->multimap || t->replace_fun != NULL){
+		for (i = lb; i < ub; i++)
+			junta_valor(t,a,&lote[i]);
+	}
+	/* sem replace_fun as keys iguais vão para a esquerda, como em insere_tree */
+	else lb = ub;
+
+	esq = insere_lote(t,NODO(t,a).esq,lote,lb,ordem);
+	dir = insere_lote(t,NODO(t,a).dir,lote + ub,n - ub,ordem);
+
+	return junta_AVL(t,esq,a,dir);
+}
+
+/**
+ * @brief			Função insere um lote de elementos na árvore.
+ * @param gl		Apontador para a estrutura que guarda a árvore.
+ * @param keys		Array com as keys a inserir.
+ * @param datas		Array com as datas a inserir.
+ * @param n			Número de elementos do lote.
+ * @return 			Apontador para a estrutura após serem inseridos os valores, NULL se não houver espaço para os
+ *					nodos do lote (a árvore fica inalterada e as keys e datas continuam a pertencer a quem chamou).
+ * @note			Cada key repetida é combinada com o valor guardado pela ordem do lote (ou, sem replace_fun,
+ *					colocada antes das keys iguais já inseridas), o que dá o mesmo resultado que inserir os elementos
+ *					um a um. O lote é aplicado numa só passagem ordenada pela árvore (O(n log(N/n + 1)) comparações
+ *					numa árvore com N nodos), exceto numa árvore limitada, onde os elementos são inseridos um a um
+ *					para respeitar a capacidade.
+*/
+TREE insere_batch_tree(TREE gl, void ** keys, void ** datas, long n){
+	struct elem * lote, * aux;
+	AVL * ordem;
+	long i, livres;
+
+	if (n <= 0)
+		return gl;
+	/* reserva já os nodos que faltam (além dos da lista de livres) para o lote não falhar a meio */
+	livres = (long) (gl->usados - 1) - gl->nnodes;
+	if (n > livres && !reserva_nodos(gl,(uint64_t) gl->usados + (n - livres)))
+		return NULL;
+	lote = malloc(n * sizeof(struct elem));
+	aux = malloc(n * sizeof(struct elem));
+	for (i = 0; i < n; i++){
+		lote[i].key = keys[i];
+		lote[i].data = datas[i];
+	}
+	ordena_lote(gl,lote,aux,n);
+	free(aux);
+
+	if (gl->capacidade > 0){
+		for (i = 0; i < n; i++)
+			insere_tree(gl,lote[i].key,lote[i].data);
+	}
+	else {
+		ordem = malloc(n * sizeof(AVL));
+		gl->arv = insere_lote(gl,gl->arv,lote,n,ordem);
+		atualiza_extremos(gl);
+		gl->ninsercoes += n;
+		free(ordem);
+	}
+	free(lote);
+
+	return gl;
+}
+
+/**
+ * @brief					Função inicializa a estrutura que contêm a árvore.
  * @param	f_compare		Apontador para a função de comparação.
  * @param	destroy_key		Apontador para a função que dá free à key.
  * @param	destroy_data	Apontador para a função que dá free à data.
  * @param	replace			Apontador para a função que dá replace à informação.
+ * @param	key_size		Tamanho das keys guardadas nos nodos (0 para guardar apontadores).
  * @return 					Apontador para a estrutura criada.
 */
-TREE createTREE(void * f_compare,void * destroy_key,void * destroy_data,void * replace){
+static TREE init_tree(void * f_compare,void * destroy_key,void * destroy_data,void * replace,size_t key_size){
     TREE a = malloc(sizeof(struct tree));
     a->nnodes = 0;
+    a->ninsercoes = 0;
     a->heigth = 0;
-    a->arv = NULL;
+    a->nodos = calloc(1,sizeof(struct AVBin));
+    a->cap = 1;
+    a->usados = 1;
+    a->livres = NIL;
+    a->arv = NIL;
+    a->menor = a->maior = NIL;
+    a->capacidade = 0;
+    a->keep = TOPK_MAX;
+    a->multimap = 0;
+    a->key_size = key_size;
 	a->replace_fun = replace;
     a->f_compare = f_compare;
 	a->destroy_key = destroy_key;
@@ -313,21 +842,80 @@ TREE createTREE(void * f_compare,void * destroy_key,void * destroy_data,void * r
 }
 
 /**
- * @brief					Função liberta a memória de uma AVL.
- * @param	a				Apontador para a AVL.
- * @param	destroy_key		Apontador para a função que destroi a key.
- * @param	destroy_data	Apontador para a função que destroi a data.
+ * @brief					Função cria a estrutura que contêm a árvore.
+ * @param	f_compare		Apontador para a função de comparação.
+ * @param	destroy_key		Apontador para a função que dá free à key.
+ * @param	destroy_data	Apontador para a função que dá free à data.
+ * @param	replace			Apontador para a função que dá replace à informação.
+ * @return 					Apontador para a estrutura criada.
+*/
+TREE createTREE(void * f_compare,void * destroy_key,void * destroy_data,void * replace){
+	return init_tree(f_compare,destroy_key,destroy_data,replace,0);
+}
+
+/**
+ * @brief					Função cria uma estrutura em modo compacto, onde as keys são copiadas para dentro dos nodos.
+ * @param	f_compare		Apontador para a função de comparação (recebe apontadores para os bytes das keys).
+ * @param	destroy_key		Apontador para a função que dá free à key passada a insere_tree, depois de copiada.
+ * @param	destroy_data	Apontador para a função que dá free à data.
+ * @param	replace			Apontador para a função que dá replace à informação.
+ * @param	key_size		Tamanho em bytes das keys (no máximo INLINE_KEY_MAX).
+ * @return 					Apontador para a estrutura criada, NULL se key_size for inválido.
 */
-static void freeAVL(AVL a,void (*destroy_key)(void *),void (*destroy_data)(void *)){
-	if (a){
-		if (destroy_key != NULL)
-			destroy_key(a->key);
-		if (destroy_data != NULL)
-			destroy_data(a->data);
-		freeAVL(a->esq,destroy_key,destroy_data);
-		freeAVL(a->dir,destroy_key,destroy_data);
-		free(a);
+TREE createTREE_compact(void * f_compare,void * destroy_key,void * destroy_data,void * replace,size_t key_size){
+	if (key_size == 0 || key_size > INLINE_KEY_MAX)
+		return NULL;
+	return init_tree(f_compare,destroy_key,destroy_data,replace,key_size);
+}
+
+/**
+ * @brief					Função cria uma estrutura limitada a um número máximo de nodos (top-K).
+ * @param	f_compare		Apontador para a função de comparação.
+ * @param	destroy_key		Apontador para a função que dá free à key.
+ * @param	destroy_data	Apontador para a função que dá free à data.
+ * @param	replace			Apontador para a função que dá replace à informação.
+ * @param	capacidade		Número máximo de nodos da árvore.
+ * @param	keep			TOPK_MAX para guardar as maiores keys, TOPK_MIN para guardar as menores.
+ * @return 					Apontador para a estrutura criada, NULL se os argumentos forem inválidos.
+*/
+TREE createTREE_bounded(void * f_compare,void * destroy_key,void * destroy_data,void * replace,long capacidade,int keep){
+	TREE a;
+	if (capacidade <= 0 || (keep != TOPK_MAX && keep != TOPK_MIN))
+		return NULL;
+	a = init_tree(f_compare,destroy_key,destroy_data,replace,0);
+	a->capacidade = capacidade;
+	a->keep = keep;
+	return a;
+}
+
+/**
+ * @brief					Função cria uma estrutura multimap, onde os valores com keys iguais são guardados no mesmo nodo.
+ * @param	f_compare		Apontador para a função de comparação.
+ * @param	destroy_key		Apontador para a função que dá free à key.
+ * @param	destroy_data	Apontador para a função que dá free à data.
+ * @param	key_size		Tamanho em bytes das keys a copiar para os nodos (0 para guardar apontadores).
+ * @return 					Apontador para a estrutura criada, NULL se key_size for inválido.
+*/
+TREE createTREE_multimap(void * f_compare,void * destroy_key,void * destroy_data,size_t key_size){
+	TREE a;
+	if (key_size > INLINE_KEY_MAX)
+		return NULL;
+	a = init_tree(f_compare,destroy_key,destroy_data,NULL,key_size);
+	a->multimap = 1;
+	return a;
+}
+
+/**
+ * @brief					Função liberta a memória dos nodos de uma estrutura.
+ * @param	t				Apontador para a estrutura.
+*/
+static void freeAVL(TREE t){
+	uint32_t i;
+	for (i = 1; i < t->usados; i++){
+		if (NODO(t,i).altura != 0)
+			destroy_node(t,i);
 	}
+	free(t->nodos);
 }
 
 
@@ -340,7 +928,7 @@ static void freeAVL(AVL a,void (*destroy_key)(void *),void (*destroy_data)(void
 */
 void freeTREE_AVL(TREE tre){
 	if(tre){
-		freeAVL(tre->arv,tre->destroy_key,tre->destroy_data);
+		freeAVL(tre);
 		free(tre);
 	}
 }
@@ -359,34 +947,98 @@ void freeTREE_AVL(TREE tre){
 void * search_AVL(TREE tree, void * key,int * valid){
 	AVL node = tree->arv;
 	int result = 0;
+	int side;
 
 	while((!result) && node){
-		if (tree->f_compare(node->key,key) == 0){
+		side = tree->f_compare(node_key(tree,node),key);
+		if (side == 0){
 			result = 1;
 		}
-		else if (tree->f_compare(node->key,key) == 1)
-			node = node->dir;
-		else node = node ->esq;
+		else if (side > 0)
+			node = NODO(tree,node).dir;
+		else node = NODO(tree,node).esq;
 	}
 	*valid = result;
 	if (result)
-		return node->data;
+		return NODO(tree,node).run ? ((struct run *) NODO(tree,node).data)->vals[0] : NODO(tree,node).data;
 	return NULL;
 }
 
+/**
+ *@brief			Função que aplica uma função a todos os valores com uma dada key.
+ *@param t			Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
+ *@param key		Apontador para a key a procurar.
+ *@param f_nodo		Função a aplicar a cada valor. (nullable)
+ *@param data1		Apontador a passar à função a aplicar.
+ *@return 			Número de valores com a key.
+*/
+static long equal_range_AVL(TREE t, AVL aux, void * key, void (*f_nodo)(void *,void *), void * data1){
+	void ** vals;
+	long i, n, k = 0;
+	int side;
+
+	while (aux){
+		side = t->f_compare(node_key(t,aux),key);
+		if (side > 0)
+			aux = NODO(t,aux).dir;
+		else if (side < 0)
+			aux = NODO(t,aux).esq;
+		else {
+			/* fora do modo multimap as keys iguais podem estar nas duas subárvores */
+			if (!t->multimap)
+				k += equal_range_AVL(t,NODO(t,aux).esq,key,f_nodo,data1);
+			vals = node_values(t,aux,&n);
+			if (f_nodo != NULL)
+				for (i = 0; i < n; i++)
+					f_nodo(vals[i],data1);
+			k += n;
+			if (t->multimap)
+				break;
+			aux = NODO(t,aux).dir;
+		}
+	}
+
+	return k;
+}
+
+/**
+ *@brief			Função que aplica uma função, por ordem, a todos os valores com uma dada key.
+ *@param tree		Estrutura que contém a árvore.
+ *@param key		Apontador para a key a procurar.
+ *@param f_nodo		Função a aplicar a cada valor. (nullable)
+ *@param data1		Apontador a passar à função a aplicar.
+ *@return 			Número de valores com a key.
+*/
+long equal_range_TREE(TREE tree, void * key, void (*f_nodo)(void *,void *), void * data1){
+	return equal_range_AVL(tree,tree->arv,key,f_nodo,data1);
+}
+
+/**
+ *@brief			Função que conta os valores com uma dada key.
+ *@param tree		Estrutura que contém a árvore.
+ *@param key		Apontador para a key a procurar.
+ *@return 			Número de valores com a key.
+*/
+long count_TREE(TREE tree, void * key){
+	return equal_range_AVL(tree,tree->arv,key,NULL,NULL);
+}
+
 /**
  *@brief			Função que testa se os nodos da AVL têm as alturas direitas
- *@param a			Apontador para a AVL.
+ *@param t			Apontador para a estrutura.
+ *@param a			Índice da raiz da AVL.
  *@return 			Inteiro a ser usado como booelan.
 */
-static int check_altura(AVL a){
+static int check_altura(TREE t, AVL a){
     int r = 1;
     int b;
     if (a){
-        b = cal_altura(a);
-        if (a->altura == b){
-            r = cal_altura(a->esq) && cal_altura(a->dir);
+        b = cal_altura(t,a);
+        if (NODO(t,a).altura == b){
+            r = check_altura(t,NODO(t,a).esq) && check_altura(t,NODO(t,a).dir);
         }
+        else r = 0;
     }
 
     return r;
@@ -394,21 +1046,26 @@ static int check_altura(AVL a){
 
 /**
  *@brief			Função que testa a AVL é de procura.
- *@param a			Apontador para a AVL.
+ *@param a			Índice da raiz da AVL.
  *@param tree		Apontador para a estrutura com a função de comparação.
  *@return 			Inteiro a ser usado como booelan.
 */
 static int isSearch(AVL a,TREE tree){
+    AVL esq, dir;
+    void * key;
     int r = 1;
     if (a){
-        if (a->dir == NULL && a->esq == NULL)
+        esq = NODO(tree,a).esq;
+        dir = NODO(tree,a).dir;
+        key = node_key(tree,a);
+        if (dir == NIL && esq == NIL)
             r = 1;
-        else if (a->dir == NULL && (tree->f_compare(a->key,a->esq->key) < 0))
-            r = isSearch(a->esq,tree);
-        else if (a->esq == NULL && (tree->f_compare(a->key,a->dir->key) > 0))
-            r = isSearch(a->dir,tree);
-        else if ((tree->f_compare(a->key,a->dir->key) > 0) && (tree->f_compare(a->key,a->esq->key) < 0))
-            r = isSearch(a->dir,tree) && isSearch(a->esq,tree);
+        else if (dir == NIL && (tree->f_compare(key,node_key(tree,esq)) < 0))
+            r = isSearch(esq,tree);
+        else if (esq == NIL && (tree->f_compare(key,node_key(tree,dir)) > 0))
+            r = isSearch(dir,tree);
+        else if ((tree->f_compare(key,node_key(tree,dir)) > 0) && (tree->f_compare(key,node_key(tree,esq)) < 0))
+            r = isSearch(dir,tree) && isSearch(esq,tree);
         else r = 0;
     }
     return r;
@@ -416,15 +1073,20 @@ static int isSearch(AVL a,TREE tree){
 
 /**
  *@brief			Função que vai ser aplicada a todos os nodos.
- *@param aux		Apontador para a arvore.
+ *@param t		Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
  *@param f_nodo		Função a aplicar a cada nodo.
  *@param data1		Apontador a passar à função a aplicar.
 */
-static void all_nodes_trans(AVL aux,void (*f_nodo)(void *,void *),void * data1){
+static void all_nodes_trans(TREE t, AVL aux,void (*f_nodo)(void *,void *),void * data1){
+	void ** vals;
+	long i, k;
 	if (aux){
-		f_nodo(aux->data,data1);
-		all_nodes_trans(aux->esq,f_nodo,data1);
-		all_nodes_trans(aux->dir,f_nodo,data1);
+		vals = node_values(t,aux,&k);
+		for (i = 0; i < k; i++)
+			f_nodo(vals[i],data1);
+		all_nodes_trans(t,NODO(t,aux).esq,f_nodo,data1);
+		all_nodes_trans(t,NODO(t,aux).dir,f_nodo,data1);
 	}
 }
 
@@ -436,12 +1098,13 @@ static void all_nodes_trans(AVL aux,void (*f_nodo)(void *,void *),void * data1){
 */
 void all_nodes_TREE(TREE e,void (*f_nodo)(void *,void *),void * data1){
 	if (f_nodo != NULL)
-		all_nodes_trans(e->arv,f_nodo,data1);
+		all_nodes_trans(e,e->arv,f_nodo,data1);
 }
 
 /**
  *@brief				Função que aplica uma função aos nodos que satisfazem uma condição.
- *@param	aux			Apontador para a AVL.
+ *@param	t			Apontador para a estrutura.
+ *@param	aux			Índice da raiz da AVL.
  *@param	inicio		Apontador para a data1 a comparar.
  *@param	fim			Apontador para a data2 a comparar.
  *@param	f_compare	Apontador para a função que compara.
@@ -449,20 +1112,24 @@ void all_nodes_TREE(TREE e,void (*f_nodo)(void *,void *),void * data1){
  *@param	data3		Aparametro 1 a passar à função que aplica nos nodos.
  *@param	data4		Aparametro 2 a passar à função que aplica nos nodos.
 */
-static void all_nodes_With_key_Condition(AVL aux,void * inicio,void * fim,int (*f_compare)(void *,void *),void (*f_nodo)(void *,void *,void *),void * data3,void * data4){
+static void all_nodes_With_key_Condition(TREE t, AVL aux,void * inicio,void * fim,int (*f_compare)(void *,void *),void (*f_nodo)(void *,void *,void *),void * data3,void * data4){
+	void ** vals;
+	long i, k;
 	int a1,a2;
 	if(aux){
-		a1 =f_compare(inicio,aux->key);
-		a2 =f_compare(fim,aux->key);
+		a1 =f_compare(inicio,node_key(t,aux));
+		a2 =f_compare(fim,node_key(t,aux));
 		if ((a1 > 0 && a2 < 0) || (a1==0) || (a2==0)){
-			all_nodes_With_key_Condition(aux->esq,inicio,fim,f_compare,f_nodo,data3,data4);
-			f_nodo(aux->data,data3,data4);
-			all_nodes_With_key_Condition(aux->dir,inicio,fim,f_compare,f_nodo,data3,data4);
+			all_nodes_With_key_Condition(t,NODO(t,aux).esq,inicio,fim,f_compare,f_nodo,data3,data4);
+			vals = node_values(t,aux,&k);
+			for (i = 0; i < k; i++)
+				f_nodo(vals[i],data3,data4);
+			all_nodes_With_key_Condition(t,NODO(t,aux).dir,inicio,fim,f_compare,f_nodo,data3,data4);
 		}
 		else if (a1 > 0)
-			all_nodes_With_key_Condition(aux->esq,inicio,fim,f_compare,f_nodo,data3,data4);
+			all_nodes_With_key_Condition(t,NODO(t,aux).esq,inicio,fim,f_compare,f_nodo,data3,data4);
 		else if (a2 < 0)
-			all_nodes_With_key_Condition(aux->dir,inicio,fim,f_compare,f_nodo,data3,data4);
+			all_nodes_With_key_Condition(t,NODO(t,aux).dir,inicio,fim,f_compare,f_nodo,data3,data4);
 	}
 }
 
@@ -476,7 +1143,7 @@ static void all_nodes_With_key_Condition(AVL aux,void * inicio,void * fim,int (*
  *@param data4		Aparametro 2 a passar à função que aplica nos nodos.
 */
 void all_nodes_With_Condition(TREE tree, void * data1, void * data2,void (*f_nodo)(void *,void *,void *),void * data3,void * data4){
-	all_nodes_With_key_Condition(tree->arv,data1,data2,tree->f_compare,f_nodo,data3,data4);
+	all_nodes_With_key_Condition(tree,tree->arv,data1,data2,tree->f_compare,f_nodo,data3,data4);
 }
 
 
@@ -487,8 +1154,8 @@ void all_nodes_With_Condition(TREE tree, void * data1, void * data2,void (*f_nod
 */
 int test_TREE_PROP(TREE tree){
 	int alturas,procura,balanceada;
-	balanceada = isBalanced(tree->arv);
-	alturas = check_altura(tree->arv);
+	balanceada = isBalanced(tree,tree->arv);
+	alturas = check_altura(tree,tree->arv);
 	procura = isSearch(tree->arv,tree);
 
 	return balanceada && alturas && procura;
@@ -500,12 +1167,13 @@ int test_TREE_PROP(TREE tree){
  *@return 			Numero de nodos da árvore.
 */
 long NUM_nodes(TREE t){
-	return t->nnodes;
+	return t->ninsercoes;
 }
 
 /**
  *@brief			Função que faz uma travessia inorder na árvore.
- *@param aux		Apontador para a arvore.
+ *@param t		Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
  *@param f_nodo		Função a aplicar a cada nodo.
  *@param data1		Apontador a passar como argumento à função a aplicar.
  *@param data2		Apontador a passar como argumento à função a aplicar.
@@ -513,25 +1181,31 @@ long NUM_nodes(TREE t){
  *@param end		Data início do intervalo a que o nodo tem de pertencer. (nullable)
  *@param n			Número máximo de nodos a percorrer. (nullable)
 */
-static void trans_inorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+static void trans_inorder(TREE t, AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+	void ** vals;
+	long i, k;
 	if (aux){
 		if (begin == NULL || end == NULL) {
-			trans_inorder(aux->esq,f_nodo,data1, data2, begin, end, n);
-			f_nodo(aux->data,data1, data2, n);
-			trans_inorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+			trans_inorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
+			vals = node_values(t,aux,&k);
+			for (i = 0; i < k; i++)
+				f_nodo(vals[i],data1, data2, n);
+			trans_inorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 		}
 		else {
-			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) aux->key );
-			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) aux->key);
+			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) node_key(t,aux) );
+			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) node_key(t,aux));
 			if(r1 >= 0 && r2 <= 0) {
-				trans_inorder(aux->esq,f_nodo,data1, data2, begin, end, n);
-				f_nodo(aux->data,data1, data2, n);
-				trans_inorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+				trans_inorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
+				vals = node_values(t,aux,&k);
+				for (i = 0; i < k; i++)
+					f_nodo(vals[i],data1, data2, n);
+				trans_inorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 			}
 			else if (r1 >= 0)
-				trans_inorder(aux->esq,f_nodo,data1, data2, begin, end, n);
+				trans_inorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
 			else if (r2 <= 0)
-				trans_inorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+				trans_inorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 		}
 	}
 }
@@ -539,7 +1213,8 @@ static void trans_inorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),v
 
 /**
  *@brief			Função que faz uma travessia revinorder na árvore.
- *@param aux		Apontador para a arvore.
+ *@param t		Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
  *@param f_nodo		Função a aplicar a cada nodo.
  *@param data1		Apontador a passar como argumento à função a aplicar.
  *@param data2		Apontador a passar como argumento à função a aplicar.
@@ -547,27 +1222,33 @@ static void trans_inorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),v
  *@param end		Data início do intervalo a que o nodo tem de pertencer. (nullable)
  *@param n			Número máximo de nodos a percorrer. (nullable)
 */
-static void trans_revinorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+static void trans_revinorder(TREE t, AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+	void ** vals;
+	long i, k;
 	if (aux){
 		if (*n <= 0)
 			return;
 		if (begin == NULL || end == NULL) {
-			trans_revinorder(aux->dir,f_nodo,data1, data2, begin, end, n);
-			f_nodo(aux->data,data1, data2, n);
-			trans_revinorder(aux->esq,f_nodo,data1, data2, begin, end, n);
+			trans_revinorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
+			vals = node_values(t,aux,&k);
+			for (i = 0; i < k && *n > 0; i++)
+				f_nodo(vals[i],data1, data2, n);
+			trans_revinorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
 		}
 		else {
-			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) aux->key );
-			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) aux->key);
+			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) node_key(t,aux) );
+			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) node_key(t,aux));
 			if(r1 >= 0 && r2 <= 0) {
-				trans_revinorder(aux->dir,f_nodo,data1, data2, begin, end, n);
-				f_nodo(aux->data,data1, data2, n);
-				trans_revinorder(aux->esq,f_nodo,data1, data2, begin, end, n);
+				trans_revinorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
+				vals = node_values(t,aux,&k);
+				for (i = 0; i < k && *n > 0; i++)
+					f_nodo(vals[i],data1, data2, n);
+				trans_revinorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
 			}
 			else if (r1 >= 0)
-				trans_revinorder(aux->esq,f_nodo,data1, data2, begin, end, n);
+				trans_revinorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
 			else if (r2 <= 0)
-				trans_revinorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+				trans_revinorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 		}
 	}
 }
@@ -575,7 +1256,8 @@ static void trans_revinorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *
 
 /**
  *@brief			Função que faz uma travessia postorder na árvore.
- *@param aux		Apontador para a arvore.
+ *@param t		Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
  *@param f_nodo		Função a aplicar a cada nodo.
  *@param data1		Apontador a passar como argumento à função a aplicar.
  *@param data2		Apontador a passar como argumento à função a aplicar.
@@ -583,34 +1265,41 @@ static void trans_revinorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *
  *@param end		Data início do intervalo a que o nodo tem de pertencer. (nullable)
  *@param n			Número máximo de nodos a percorrer. (nullable)
 */
-static void trans_posorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+static void trans_posorder(TREE t, AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+	void ** vals;
+	long i, k;
 	if (aux){
 		if (*n <= 0)
 			return;
 		if (begin == NULL || end == NULL) {
-			trans_posorder(aux->esq,f_nodo,data1, data2, begin, end, n);
-			trans_posorder(aux->dir,f_nodo,data1, data2, begin, end, n);
-			f_nodo(aux->data,data1, data2, n);
+			trans_posorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
+			trans_posorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
+			vals = node_values(t,aux,&k);
+			for (i = 0; i < k && *n > 0; i++)
+				f_nodo(vals[i],data1, data2, n);
 		}
 		else {
-			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) aux->key );
-			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) aux->key);
+			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) node_key(t,aux) );
+			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) node_key(t,aux));
 			if(r1 >= 0 && r2 <= 0) {
-				trans_posorder(aux->esq,f_nodo,data1, data2, begin, end, n);
-				trans_posorder(aux->dir,f_nodo,data1, data2, begin, end, n);
-				f_nodo(aux->data,data1, data2, n);
+				trans_posorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
+				trans_posorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
+				vals = node_values(t,aux,&k);
+				for (i = 0; i < k && *n > 0; i++)
+					f_nodo(vals[i],data1, data2, n);
 			}
 			else if (r1 >= 0)
-				trans_posorder(aux->esq,f_nodo,data1, data2, begin, end, n);
+				trans_posorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
 			else if (r2 <= 0)
-				trans_posorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+				trans_posorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 		}
 	}
 }
 
 /**
  *@brief			Função que faz uma travessia preorder na árvore.
- *@param aux		Apontador para a arvore.
+ *@param t		Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
  *@param f_nodo		Função a aplicar a cada nodo.
  *@param data1		Apontador a passar como argumento à função a aplicar.
  *@param data2		Apontador a passar como argumento à função a aplicar.
@@ -618,27 +1307,33 @@ static void trans_posorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),
  *@param end		Data início do intervalo a que o nodo tem de pertencer. (nullable)
  *@param n			Número máximo de nodos a percorrer. (nullable)
 */
-static void trans_preorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+static void trans_preorder(TREE t, AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end, int * n){
+	void ** vals;
+	long i, k;
 	if (aux){
 		if (*n <= 0)
 			return;
 		if (begin == NULL || end == NULL) {
-			f_nodo(aux->data,data1, data2, n);
-			trans_posorder(aux->esq,f_nodo,data1, data2, begin, end, n);
-			trans_posorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+			vals = node_values(t,aux,&k);
+			for (i = 0; i < k && *n > 0; i++)
+				f_nodo(vals[i],data1, data2, n);
+			trans_posorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
+			trans_posorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 		}
 		else {
-			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) aux->key );
-			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) aux->key);
+			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) node_key(t,aux) );
+			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) node_key(t,aux));
 			if(r1 >= 0 && r2 <= 0) {
-				f_nodo(aux->data,data1, data2, n);
-				trans_preorder(aux->esq,f_nodo,data1, data2, begin, end, n);
-				trans_preorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+				vals = node_values(t,aux,&k);
+				for (i = 0; i < k && *n > 0; i++)
+					f_nodo(vals[i],data1, data2, n);
+				trans_preorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
+				trans_preorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 			}
 			else if (r1 >= 0)
-				trans_preorder(aux->esq,f_nodo,data1, data2, begin, end, n);
+				trans_preorder(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end, n);
 			else if (r2 <= 0)
-				trans_preorder(aux->dir,f_nodo,data1, data2, begin, end, n);
+				trans_preorder(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end, n);
 		}
 
 	}
@@ -648,7 +1343,8 @@ static void trans_preorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),
 
 /**
  *@brief			Função que faz uma travessia na árvore com 4 argumentos.
- *@param aux		Apontador para a arvore.
+ *@param t		Apontador para a estrutura.
+ *@param aux		Índice da raiz da arvore.
  *@param f_nodo		Função a aplicar a cada nodo.
  *@param data1		Apontador a passar como argumento à função a aplicar.
  *@param data2		Apontador a passar como argumento à função a aplicar.
@@ -656,25 +1352,31 @@ static void trans_preorder(AVL aux,void (*f_nodo)(void *,void *,void *, void *),
  *@param end		Data início do intervalo a que o nodo tem de pertencer. (nullable)
  *@param n			Número máximo de nodos a percorrer. (nullable)
 */
-static void trans_4_args(AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end){
+static void trans_4_args(TREE t, AVL aux,void (*f_nodo)(void *,void *,void *, void *),void * data1, void * data2, void * begin, void * end){
+	void ** vals;
+	long i, k;
 	if (aux){
 		if (begin == NULL || end == NULL) {
-			trans_4_args(aux->esq,f_nodo,data1, data2, begin, end);
-			f_nodo(aux->data,data1, begin,end);
-			trans_4_args(aux->dir,f_nodo,data1, data2, begin, end);
+			trans_4_args(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end);
+			vals = node_values(t,aux,&k);
+			for (i = 0; i < k; i++)
+				f_nodo(vals[i],data1, begin,end);
+			trans_4_args(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end);
 		}
 		else {
-			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) aux->key );
-			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) aux->key);
+			int r1 = compare_MYDATE_AVL((MYDATE) begin, (MYDATE) node_key(t,aux) );
+			int r2 = compare_MYDATE_AVL((MYDATE) end, (MYDATE) node_key(t,aux));
 			if(r1 >= 0 && r2 <= 0) {
-				trans_4_args(aux->esq,f_nodo,data1, data2, begin, end);
-				f_nodo(aux->data,data1, begin,end);
-				trans_4_args(aux->dir,f_nodo,data1, data2, begin, end);
+				trans_4_args(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end);
+				vals = node_values(t,aux,&k);
+				for (i = 0; i < k; i++)
+					f_nodo(vals[i],data1, begin,end);
+				trans_4_args(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end);
 			}
 			else if (r1 >= 0)
-				trans_4_args(aux->esq,f_nodo,data1, data2, begin, end);
+				trans_4_args(t,NODO(t,aux).esq,f_nodo,data1, data2, begin, end);
 			else if (r2 <= 0)
-				trans_4_args(aux->dir,f_nodo,data1, data2, begin, end);
+				trans_4_args(t,NODO(t,aux).dir,f_nodo,data1, data2, begin, end);
 		}
 	}
 }
@@ -695,15 +1397,15 @@ void trans_tree(TREE e,void (*f_nodo)(void *,void *,void *, void *),void * data1
 	if (!e)
 		return;
 	if (travessia == 1)
-		trans_posorder(e->arv,f_nodo,data1, data2, begin, end, &n);
+		trans_posorder(e,e->arv,f_nodo,data1, data2, begin, end, &n);
 	else if (travessia == 2)
-		trans_inorder(e->arv,f_nodo,data1, data2, begin, end, &n);
+		trans_inorder(e,e->arv,f_nodo,data1, data2, begin, end, &n);
 	else if (travessia == 3)
-		trans_preorder(e->arv,f_nodo,data1, data2, begin, end, &n);
+		trans_preorder(e,e->arv,f_nodo,data1, data2, begin, end, &n);
 	else if (travessia == 4) {
-		trans_revinorder(e->arv, f_nodo, data1, data2, begin, end, &n);
+		trans_revinorder(e,e->arv, f_nodo, data1, data2, begin, end, &n);
 	}
 	else if (travessia == 5){
-		trans_4_args(e->arv, f_nodo, data1, data2, begin, end);
+		trans_4_args(e,e->arv, f_nodo, data1, data2, begin, end);
 	}
 }